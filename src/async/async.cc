@@ -0,0 +1,194 @@
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+
+#include "async.h"
+
+Loop *get_loop () {
+    static Loop loop;
+    return &loop;
+}
+
+Loop::Loop () {
+    stop = false;
+    tasks = 0;
+    event = eventfd(0, EFD_NONBLOCK);
+
+    workers = IO_THREAD_NUM;
+    for (unsigned long i = 0; i < workers; i++) threads.emplace_back(&Loop::work, this, i);
+}
+
+Loop::~Loop () {
+    {
+        lock_guard<mutex> guard(lock);
+        stop = true;
+    }
+    cond.notify_all();
+
+    for (thread& worker : threads) worker.join();
+    close(event);
+}
+
+void Loop::work (unsigned long id) {
+    while (true) {
+        unique_lock<mutex> guard(lock);
+        cond.wait(guard, [this, id] { return stop || id >= workers || requests.size() > 0; });
+
+        if (stop || id >= workers) return;
+
+        Request request = requests.front();
+        requests.pop_front();
+        guard.unlock();
+
+        request.page->load(request.fd, request.offset);
+
+        guard.lock();
+        done.push_back(request.page);
+        guard.unlock();
+
+        unsigned long count = 1;
+        write(event, &count, sizeof(count));
+    }
+}
+
+bool Loop::ready (File *file, unsigned long page_id) {
+    // Header pages are read in place, every other load holds one anyway.
+    if (page_id == 0) {
+        file->get_page(0);
+        return true;
+    }
+    // Hits keep a shrinking pool moving, as they do on the synchronous path.
+    Buffer *buffer = get_buffer();
+    buffer->trim();
+
+    auto iter = file->pages.find(page_id);
+    if (iter == file->pages.end() || waiters.find(iter->second) != waiters.end()) return false;
+
+    buffer->touch(iter->second);
+
+    return true;
+}
+
+Page *Loop::find (File *file, unsigned long page_id) { return file->pages[page_id]; }
+
+void Loop::load (File *file, unsigned long page_id, coroutine_handle<> handle) {
+    auto iter = file->pages.find(page_id);
+
+    if (iter != file->pages.end() && waiters.find(iter->second) != waiters.end()) {
+        waiters[iter->second].push_back(handle);
+        return;
+    }
+    Buffer *buffer = get_buffer();
+    buffer->hold(file);
+
+    Page *page = buffer->get_page();
+
+    page->file = file;
+    page->page_id = page_id;
+
+    file->pages[page_id] = page;
+    waiters[page].push_back(handle);
+
+    Request request;
+    request.page = page;
+    request.fd = file->locate(page_id, &request.offset);
+
+    file->reading += 1;
+
+    {
+        lock_guard<mutex> guard(lock);
+        requests.push_back(request);
+    }
+    cond.notify_one();
+}
+
+// Drains the eventfd before taking the finished reads, a read that completes
+// in between signals it again. Returns at once when nothing has finished.
+void Loop::poll () {
+    unsigned long count;
+    read(event, &count, sizeof(count));
+
+    vector<Page*> pages;
+
+    {
+        lock_guard<mutex> guard(lock);
+        pages.swap(done);
+    }
+    for (Page *page : pages) {
+        File *file = page->file;
+        unsigned long page_id = page->page_id;
+
+        vector<coroutine_handle<>> handles;
+        handles.swap(waiters[page]);
+        waiters.erase(page);
+
+        file->reading -= 1;
+        get_buffer()->push(page);
+
+        // A waiter resumed earlier may have evicted the page again, the rest then wait for a reload.
+        for (unsigned long i = 0; i < handles.size(); i++) {
+            auto iter = file->pages.find(page_id);
+
+            if (iter == file->pages.end() || waiters.find(iter->second) != waiters.end()) load(file, page_id, handles[i]);
+            else handles[i].resume();
+        }
+    }
+}
+
+void Loop::run () {
+    struct pollfd temp = { event, POLLIN, 0 };
+
+    while (tasks) {
+        ::poll(&temp, 1, -1);
+        poll();
+    }
+}
+
+int Loop::fd () { return event; }
+
+// Threads above the new count finish their current read and exit.
+void Loop::resize (unsigned long num) {
+    num = num < 1 ? 1 : num;
+
+    {
+        lock_guard<mutex> guard(lock);
+        workers = num;
+    }
+    cond.notify_all();
+
+    for (; threads.size() > num; threads.pop_back()) threads.back().join();
+    while (threads.size() < num) threads.emplace_back(&Loop::work, this, threads.size());
+}
+
+void Loop::spawn (Task task, int *status, Group *group) {
+    tasks += 1;
+    if (group) group->count += 1;
+
+    detach(std::move(task), status, group);
+}
+
+Detach Loop::detach (Task task, int *status, Group *group) {
+    int value = co_await task;
+
+    if (status) *status = value;
+    finish(group);
+}
+
+void Loop::finish (Group *group) {
+    tasks -= 1;
+
+    if (!group || --group->count || !group->waiter) return;
+
+    coroutine_handle<> waiter = group->waiter;
+    group->waiter = NULL;
+
+    waiter.resume();
+}
+
+Fetch Loop::fetch (File *file, unsigned long page_id) { return Fetch { file, page_id }; }
+
+bool Fetch::await_ready () { return get_loop()->ready(file, page_id); }
+
+void Fetch::await_suspend (coroutine_handle<> handle) { get_loop()->load(file, page_id, handle); }
+
+Page *Fetch::await_resume () { return get_loop()->find(file, page_id); }
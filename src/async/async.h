@@ -0,0 +1,141 @@
+#ifndef _ASYNC_H_
+#define _ASYNC_H_
+
+#include <coroutine>
+#include <exception>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "../buffer/buffer.h"
+#include "../config.h"
+
+using namespace std;
+
+class Task {
+public:
+    struct promise_type;
+
+    struct Final {
+        bool await_ready () noexcept { return false; }
+        coroutine_handle<> await_suspend (coroutine_handle<promise_type> handle) noexcept {
+            coroutine_handle<> next = handle.promise().next;
+            return next ? next : noop_coroutine();
+        }
+        void await_resume () noexcept {}
+    };
+
+    struct promise_type {
+        int value;
+        coroutine_handle<> next;
+
+        Task get_return_object () { return Task(coroutine_handle<promise_type>::from_promise(*this)); }
+        suspend_always initial_suspend () { return {}; }
+        Final final_suspend () noexcept { return {}; }
+        void return_value (int value) { this->value = value; }
+        void unhandled_exception () { terminate(); }
+    };
+
+    Task (coroutine_handle<promise_type> handle) : handle(handle) {}
+    Task (Task&& task) : handle(task.handle) { task.handle = NULL; }
+    ~Task () { if (handle) handle.destroy(); }
+
+    bool await_ready () { return false; }
+    coroutine_handle<> await_suspend (coroutine_handle<> next) {
+        handle.promise().next = next;
+        return handle;
+    }
+    int await_resume () { return handle.promise().value; }
+
+private:
+    coroutine_handle<promise_type> handle;
+};
+
+struct Detach {
+    struct promise_type {
+        Detach get_return_object () { return {}; }
+        suspend_never initial_suspend () { return {}; }
+        suspend_never final_suspend () noexcept { return {}; }
+        void return_void () {}
+        void unhandled_exception () { terminate(); }
+    };
+};
+
+struct Group {
+    int count = 0;
+    coroutine_handle<> waiter;
+
+    bool await_ready () { return !count; }
+    void await_suspend (coroutine_handle<> handle) { waiter = handle; }
+    void await_resume () {}
+};
+
+struct Fetch {
+    File *file;
+    unsigned long page_id;
+
+    bool await_ready ();
+    void await_suspend (coroutine_handle<> handle);
+    Page *await_resume ();
+};
+
+typedef struct {
+    Page *page;
+    int fd;
+    unsigned long offset;
+} Request;
+
+// Tasks run on the thread that calls poll or run, only page reads are
+// handed to the I/O threads. Synchronous Bptree calls must not overlap
+// with tasks that are still in flight. fd is readable while finished
+// reads are pending, an application can wait on it and call poll.
+// Each I/O thread does one blocking pread at a time, so the device sees
+// at most as many reads as there are threads (IO_THREAD_NUM, see resize),
+// however many tasks are suspended.
+class Loop {
+    friend Loop *get_loop ();
+    friend class AsyncBptree;
+    friend struct Fetch;
+
+    vector<thread> threads;
+    mutex lock;
+    condition_variable cond;
+
+    deque<Request> requests;
+    vector<Page*> done;
+    bool stop;
+    unsigned long workers;
+
+    int event;
+    unsigned long tasks;
+
+    unordered_map<Page*, vector<coroutine_handle<>>> waiters;
+
+    Loop ();
+    ~Loop ();
+
+    void work (unsigned long id);
+    bool ready (File *file, unsigned long page_id);
+    void load (File *file, unsigned long page_id, coroutine_handle<> handle);
+    Page *find (File *file, unsigned long page_id);
+    void finish (Group *group);
+
+    Detach detach (Task task, int *status, Group *group);
+    Fetch fetch (File *file, unsigned long page_id);
+
+public:
+    void spawn (Task task, int *status=NULL, Group *group=NULL);
+
+    int fd ();
+    void poll ();
+    void run ();
+
+    void resize (unsigned long num);
+};
+
+Loop *get_loop ();
+
+#endif
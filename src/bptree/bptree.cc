@@ -33,16 +33,24 @@ void Bptree::pull (Node *node, Addr *addr) {
     node->total -= 1;
 }
 
-Attr Bptree::fetch_attr (string name) { return *(Attr *)(void *)((*get_buffer())[name_to_path(name) + ".idx"]->fetch_info()->reserved); }
+Attr Bptree::fetch_attr (string name) {
+    File *file = (*get_buffer())[name_to_path(name) + ".idx"];
+    return file ? *(Attr *)(void *)(file->fetch_info()->reserved) : Attr();
+}
+
+Stat Bptree::fetch_stat (string name) {
+    File *file = (*get_buffer())[name_to_path(name) + ".db"];
+    return file ? file->fetch_stat() : Stat();
+}
 
 int Bptree::create_form (string name, Attr *attr) {
-    if (access((name_to_path(name) + ".idx").c_str(), F_OK) == 0) return INDEX_FILE_EXISTED;
-    if (access((name_to_path(name) + ".db").c_str(), F_OK) == 0) return DB_FILE_EXISTED;
+    if (get_buffer()->exist_file(name_to_path(name) + ".idx")) return INDEX_FILE_EXISTED;
+    if (get_buffer()->exist_file(name_to_path(name) + ".db")) return DB_FILE_EXISTED;
 
     Buffer *buffer = get_buffer();
 
     buffer->create_file(name_to_path(name) + ".idx");
-    buffer->create_file(name_to_path(name) + ".db");
+    buffer->create_file(name_to_path(name) + ".db", attr->compress);
 
     File *file = (*buffer)[name_to_path(name) + ".idx"];
 
@@ -63,8 +71,8 @@ int Bptree::create_form (string name, Attr *attr) {
 }
 
 int Bptree::delete_form (string name) {
-    if (access((name_to_path(name) + ".idx").c_str(), F_OK)) return INDEX_FILE_NOT_FOUND;
-    if (access((name_to_path(name) + ".db").c_str(), F_OK)) return DB_FILE_NOT_FOUND;
+    if (!get_buffer()->exist_file(name_to_path(name) + ".idx")) return INDEX_FILE_NOT_FOUND;
+    if (!get_buffer()->exist_file(name_to_path(name) + ".db")) return DB_FILE_NOT_FOUND;
 
     Buffer *buffer = get_buffer();
 
@@ -75,8 +83,8 @@ int Bptree::delete_form (string name) {
 }
 
 int Bptree::insert_data (string name, void *src, int (*cmp) (const void *, const void *, const int)) {
-    if (access((name_to_path(name) + ".idx").c_str(), F_OK)) return INDEX_FILE_NOT_FOUND;
-    if (access((name_to_path(name) + ".db").c_str(), F_OK)) return DB_FILE_NOT_FOUND;
+    if (!get_buffer()->exist_file(name_to_path(name) + ".idx")) return INDEX_FILE_NOT_FOUND;
+    if (!get_buffer()->exist_file(name_to_path(name) + ".db")) return DB_FILE_NOT_FOUND;
 
     File *file = (*get_buffer())[name_to_path(name) + ".idx"];
     Attr *attr = (Attr *)(void *)(file->fetch_info()->reserved);
@@ -157,8 +165,8 @@ void Bptree::split (File *file, Node *root, Node *node, Addr *addr) {
 }
 
 int Bptree::remove_data_by_index (string name, void *src, int (*cmp) (const void *, const void *, const int)) {
-    if (access((name_to_path(name) + ".idx").c_str(), F_OK)) return INDEX_FILE_NOT_FOUND;
-    if (access((name_to_path(name) + ".db").c_str(), F_OK)) return DB_FILE_NOT_FOUND;
+    if (!get_buffer()->exist_file(name_to_path(name) + ".idx")) return INDEX_FILE_NOT_FOUND;
+    if (!get_buffer()->exist_file(name_to_path(name) + ".db")) return DB_FILE_NOT_FOUND;
 
     File *file = (*get_buffer())[name_to_path(name) + ".idx"];
     Attr *attr = (Attr *)(void *)(file->fetch_info()->reserved);
@@ -241,6 +249,7 @@ void Bptree::merge (File *file, Page *page, Page *last, Node *root, Node *node,
     memcpy(node->child + node->total, temp->child, temp->total * sizeof(Addr));
 
     node->total += temp->total;
+    if (node->leaf) node->next = temp->next;
 
     file->remove_item(*(addr + 1));
     pull(root, addr + 1);
@@ -249,8 +258,8 @@ void Bptree::merge (File *file, Page *page, Page *last, Node *root, Node *node,
 }
 
 int Bptree::update_data_by_index (string name, void *src, void *tar, int (*cmp) (const void *, const void *, const int)) {
-    if (access((name_to_path(name) + ".idx").c_str(), F_OK)) return INDEX_FILE_NOT_FOUND;
-    if (access((name_to_path(name) + ".db").c_str(), F_OK)) return DB_FILE_NOT_FOUND;
+    if (!get_buffer()->exist_file(name_to_path(name) + ".idx")) return INDEX_FILE_NOT_FOUND;
+    if (!get_buffer()->exist_file(name_to_path(name) + ".db")) return DB_FILE_NOT_FOUND;
 
     File *file = (*get_buffer())[name_to_path(name) + ".idx"];
     Attr *attr = (Attr *)(void *)(file->fetch_info()->reserved);
@@ -263,8 +272,8 @@ int Bptree::update_data_by_index (string name, void *src, void *tar, int (*cmp)
 }
 
 int Bptree::search_data_by_index (string name, void *src, void *tar, int (*cmp) (const void *, const void *, const int)) {
-    if (access((name_to_path(name) + ".idx").c_str(), F_OK)) return INDEX_FILE_NOT_FOUND;
-    if (access((name_to_path(name) + ".db").c_str(), F_OK)) return DB_FILE_NOT_FOUND;
+    if (!get_buffer()->exist_file(name_to_path(name) + ".idx")) return INDEX_FILE_NOT_FOUND;
+    if (!get_buffer()->exist_file(name_to_path(name) + ".db")) return DB_FILE_NOT_FOUND;
 
     File *file = (*get_buffer())[name_to_path(name) + ".idx"];
     Attr *attr = (Attr *)(void *)(file->fetch_info()->reserved);
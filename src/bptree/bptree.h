@@ -9,13 +9,14 @@
 
 using namespace std;
 
-typedef struct {
+typedef struct Attr {
     char index, count;
     char name[ITEM_NUM * KEY_SIZE];
     char key_size[ITEM_NUM];
     char val_size[ITEM_NUM];
     char type[ITEM_NUM];
     Addr head, tail;
+    bool compress = false;
 } Attr;
 
 typedef struct {
@@ -28,6 +29,7 @@ typedef struct {
 
 class Bptree {
     friend Bptree *get_bptree ();
+    friend class AsyncBptree;
 
     void push (Node *node, Addr *addr, void *src, void *tar);
     void pull (Node *node, Addr *addr);
@@ -55,6 +57,7 @@ public:
     int search_data_by_index (string name, void *src, void *tar, int (*cmp) (const void *, const void *, const int));
 
     Attr fetch_attr (string name);
+    Stat fetch_stat (string name);
 };
 
 Bptree *get_bptree ();
@@ -0,0 +1,120 @@
+#include <string.h>
+
+#include "bptree_async.h"
+
+AsyncBptree *get_async_bptree () {
+    static AsyncBptree bptree;
+    return &bptree;
+}
+
+// Coroutine variants suspend on every buffer miss. Node pointers do not survive a
+// suspension, so only copied addresses are carried from one step to the next.
+
+Task AsyncBptree::search_leaf (File *file, Addr *addr, void *src, int size, int (*cmp) (const void *, const void *, const int)) {
+    while (true) {
+        Page *page = co_await get_loop()->fetch(file, addr->page_id);
+        Node *node = (Node *)(void *)((Addr *)(*page)[addr->offset] + 1);
+
+        if (node->leaf) co_return 0;
+
+        Addr *temp = get_bptree()->binary_search(node, false, 0, node->total - 1, src, size, cmp);
+        *addr = temp ? *temp : node->child[0];
+    }
+}
+
+Task AsyncBptree::search_item (string name, void *src, Addr *addr, int (*cmp) (const void *, const void *, const int)) {
+    if (!get_buffer()->exist_file(name_to_path(name) + ".idx")) co_return INDEX_FILE_NOT_FOUND;
+    if (!get_buffer()->exist_file(name_to_path(name) + ".db")) co_return DB_FILE_NOT_FOUND;
+
+    File *file = (*get_buffer())[name_to_path(name) + ".idx"];
+    Attr attr = *(Attr *)(void *)(file->fetch_info()->reserved);
+    int size = attr.val_size[(int)attr.index];
+
+    *addr = attr.head;
+    co_await search_leaf(file, addr, src, size, cmp);
+
+    Page *page = co_await get_loop()->fetch(file, addr->page_id);
+    Node *node = (Node *)(void *)((Addr *)(*page)[addr->offset] + 1);
+    Addr *temp = get_bptree()->binary_search(node, true, 0, node->total - 1, src, size, cmp);
+
+    if (!temp) co_return ITEM_NOT_FOUND;
+    *addr = *temp;
+
+    co_return 0;
+}
+
+Task AsyncBptree::update_data_by_index (string name, void *src, void *tar, int (*cmp) (const void *, const void *, const int)) {
+    Addr addr;
+
+    if (int err = co_await search_item(name, src, &addr, cmp)) co_return err;
+
+    Attr attr = get_bptree()->fetch_attr(name);
+    Page *page = co_await get_loop()->fetch((*get_buffer())[name_to_path(name) + ".db"], addr.page_id);
+
+    memcpy((Addr *)((*page)[addr.offset]) + 1, tar, attr.count * VAL_SIZE);
+    page->updated = true;
+
+    co_return 0;
+}
+
+Task AsyncBptree::search_data_by_index (string name, void *src, void *tar, int (*cmp) (const void *, const void *, const int)) {
+    Addr addr;
+
+    if (int err = co_await search_item(name, src, &addr, cmp)) co_return err;
+
+    Attr attr = get_bptree()->fetch_attr(name);
+    Page *page = co_await get_loop()->fetch((*get_buffer())[name_to_path(name) + ".db"], addr.page_id);
+
+    memcpy(tar, (Addr *)((*page)[addr.offset]) + 1, attr.count * VAL_SIZE);
+
+    co_return 0;
+}
+
+Task AsyncBptree::search_batch_by_index (string name, int num, void **src, void **tar, int *status, int (*cmp) (const void *, const void *, const int)) {
+    Group group;
+
+    for (int i = 0; i < num; i++) get_loop()->spawn(search_data_by_index(name, src[i], tar[i], cmp), status ? status + i : NULL, &group);
+    co_await group;
+
+    co_return 0;
+}
+
+Task AsyncBptree::scan_data_by_index (string name, void *src, void *tar, int num, int *total, int (*cmp) (const void *, const void *, const int)) {
+    *total = 0;
+
+    if (!get_buffer()->exist_file(name_to_path(name) + ".idx")) co_return INDEX_FILE_NOT_FOUND;
+    if (!get_buffer()->exist_file(name_to_path(name) + ".db")) co_return DB_FILE_NOT_FOUND;
+
+    File *file = (*get_buffer())[name_to_path(name) + ".idx"];
+    File *data = (*get_buffer())[name_to_path(name) + ".db"];
+
+    Attr attr = *(Attr *)(void *)(file->fetch_info()->reserved);
+    int size = attr.val_size[(int)attr.index];
+
+    Addr leaf = attr.head;
+    co_await search_leaf(file, &leaf, src, size, cmp);
+
+    int index = -1;
+
+    while (*total < num) {
+        Page *page = co_await get_loop()->fetch(file, leaf.page_id);
+        Node *node = (Node *)(void *)((Addr *)(*page)[leaf.offset] + 1);
+
+        if (index < 0) for (index = 0; index < node->total && cmp(src, node->index + index * VAL_SIZE, size) > 0; index++);
+
+        if (index == node->total) {
+            if (!node->next.page_id && !node->next.offset) break;
+
+            leaf = node->next;
+            index = 0;
+
+            continue;
+        }
+        Addr addr = node->child[index++];
+        Page *temp = co_await get_loop()->fetch(data, addr.page_id);
+
+        memcpy((char *)tar + *total * attr.count * VAL_SIZE, (Addr *)((*temp)[addr.offset]) + 1, attr.count * VAL_SIZE);
+        *total += 1;
+    }
+    co_return 0;
+}
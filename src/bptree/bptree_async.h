@@ -0,0 +1,27 @@
+#ifndef _BPTREE_ASYNC_H_
+#define _BPTREE_ASYNC_H_
+
+#include <string>
+
+#include "bptree.h"
+#include "../async/async.h"
+
+using namespace std;
+
+// Kept apart from bptree.h so that synchronous callers do not need C++20.
+class AsyncBptree {
+    friend AsyncBptree *get_async_bptree ();
+
+    Task search_leaf (File *file, Addr *addr, void *src, int size, int (*cmp) (const void *, const void *, const int));
+    Task search_item (string name, void *src, Addr *addr, int (*cmp) (const void *, const void *, const int));
+
+public:
+    Task update_data_by_index (string name, void *src, void *tar, int (*cmp) (const void *, const void *, const int));
+    Task search_data_by_index (string name, void *src, void *tar, int (*cmp) (const void *, const void *, const int));
+    Task search_batch_by_index (string name, int num, void **src, void **tar, int *status, int (*cmp) (const void *, const void *, const int));
+    Task scan_data_by_index (string name, void *src, void *tar, int num, int *total, int (*cmp) (const void *, const void *, const int));
+};
+
+AsyncBptree *get_async_bptree ();
+
+#endif
@@ -1,17 +1,52 @@
 #include <unistd.h>
 #include <string.h>
 #include <fcntl.h>
+#include <stdlib.h>
+#include <sys/mman.h>
 
 #include <iostream>
 
 #include "buffer.h"
+#include "../compress/compress.h"
+#include "../space/space.h"
 
 Buffer *get_buffer () {
     static Buffer buffer;
     return &buffer;
 }
 
-inline Buffer::Buffer () { dummy.last = dummy.next = &dummy; }
+Buffer::Buffer () {
+    dummy.last = dummy.next = &dummy;
+    opened.last = opened.next = &opened;
+    handles = 0;
+
+    // Constructed first so that it outlives the final write-backs in ~Buffer.
+    if (TABLESPACE) get_space();
+
+    // Address space is reserved for MEM_PAGE_MAX frames, only frames in use are backed.
+    size = ((unsigned long)MEM_PAGE_MAX * PAGE_SIZE + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    arena = (char *)MAP_FAILED;
+
+    // Huge pages are reserved up front, an unbacked hugetlb mapping would fault with SIGBUS on first touch.
+    if (HUGE_PAGE) arena = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (arena == MAP_FAILED) {
+        if (HUGE_PAGE) cerr << "buffer: not enough hugetlb pages reserved, using transparent huge pages" << endl;
+
+        arena = (char *)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (HUGE_PAGE) madvise(arena, size, MADV_HUGEPAGE);
+    }
+    if (arena == MAP_FAILED) {
+        cerr << "buffer: cannot map " << size << " bytes for the page arena" << endl;
+        abort();
+    }
+    frames = new Page[MEM_PAGE_MAX]();
+    for (unsigned long i = 0; i < MEM_PAGE_MAX; i++) frames[i].memory = arena + i * PAGE_SIZE;
+
+    if (HUGE_PAGE) spare.assign(size / HUGE_PAGE_SIZE, HUGE_PAGE_SIZE / PAGE_SIZE);
+
+    count = tick = 0;
+    limit = MEM_PAGE_NUM < MEM_PAGE_MAX ? MEM_PAGE_NUM : MEM_PAGE_MAX;
+}
 
 Buffer::~Buffer () {
     vector<string> paths;
@@ -20,12 +55,18 @@ Buffer::~Buffer () {
     for (string path : paths) quit_file(path);
 
     for (File *file : idles) delete file;
-    for (Page *page : pages) delete page;
+
+    delete[] frames;
+    munmap(arena, size);
 }
 
 void Buffer::pull (Page *page) {
     page->last->next = page->next;
     page->next->last = page->last;
+
+    page->last = page->next = NULL;
+
+    if (HUGE_PAGE) used.erase(page);
 }
 
 void Buffer::push (Page *page) {
@@ -34,53 +75,149 @@ void Buffer::push (Page *page) {
 
     page->next = &dummy;
     dummy.last = page;
+
+    page->stamp = tick++;
+
+    if (HUGE_PAGE) used.insert(page);
+}
+
+void Buffer::pull (File *file) {
+    file->last->next = file->next;
+    file->next->last = file->last;
+
+    file->last = file->next = NULL;
+}
+
+void Buffer::push (File *file) {
+    file->last = opened.last;
+    opened.last->next = file;
+
+    file->next = &opened;
+    opened.last = file;
+}
+
+// Moves a page to the recent end of the LRU without touching the set of used frames.
+// Pages that are off the LRU (held headers, pages still being read) are left where they are.
+void Buffer::touch (Page *page) {
+    if (!page->next) return;
+
+    page->last->next = page->next;
+    page->next->last = page->last;
+
+    page->last = dummy.last;
+    dummy.last->next = page;
+
+    page->next = &dummy;
+    dummy.last = page;
+
+    page->stamp = tick++;
+}
+
+// A header page leaves the LRU while other pages of its file are resident or being
+// read, their write-backs update it. Once the last of them is gone it is evictable again.
+void Buffer::hold (File *file) {
+    Page *page = file->get_page(0);
+    if (!file->refs++) pull(page);
+}
+
+void Buffer::drop (File *file) {
+    if (!--file->refs) push(file->pages[0]);
 }
 
 Page *Buffer::add_page (File *file, unsigned long page_id) {
-    Page *page = get_page(file);
+    Page *page = get_page();
 
     page->init(file, page_id);
-
-    if (page_id) push(page);
-    else pinned[file->path] = page;
+    push(page);
 
     return page;
 }
 
-Page *Buffer::get_page (File *file) {
+Page *Buffer::get_page () {
     Page *page = NULL;
 
+    // Every frame in use counts against the limit, header pages included.
+    if (count - pages.size() >= limit && dummy.next != &dummy) {
+        page = lru_page();
+
+        if (!HUGE_PAGE) {
+            trim();
+            return page;
+        }
+        // With huge pages the victim's frame is swapped for the lowest free one.
+        release(page);
+    }
     if (pages.size() > 0) {
-        page = pages.front();
+        page = *pages.begin();
         pages.erase(pages.begin());
+        take(page);
     }
-    else if (count < MEM_PAGE_NUM) {
-        page = new Page();
-        count += 1;
+    else if (count < MEM_PAGE_MAX) take(page = frames + count++);
+    else {
+        // Only reachable with every frame held by a header or a read in flight.
+        cerr << "buffer: no frame left to evict" << endl;
+        abort();
     }
-    else page = lru_page(file);
+    trim();
 
     return page;
 }
 
-Page *Buffer::lru_page (File *file) {
-    Page *page = dummy.next;
-
-    if (page == &dummy) {
-        page = pinned.begin()->second->file == file ? pinned.end()->second : pinned.begin()->second;
-        quit_file(page->file->path);
+Page *Buffer::lru_page (Page *page) {
+    if (!page) page = dummy.next;
 
-        return get_page(file);
-    }
+    File *file = page->file;
     if (page->updated) page->write_back();
 
-    page->file->pages.erase(page->page_id);
+    file->pages.erase(page->page_id);
     pull(page);
 
+    if (page->page_id) drop(file);
+
     return page;
 }
 
-void Buffer::open_file (string path, bool flag) {
+void Buffer::take (Page *page) {
+    if (HUGE_PAGE) spare[(page - frames) * PAGE_SIZE / HUGE_PAGE_SIZE] -= 1;
+}
+
+// Huge pages cannot be released piecemeal, they go back once all of their frames are free.
+void Buffer::release (Page *page) {
+    pages.insert(page);
+
+    if (!HUGE_PAGE) {
+        madvise(page->memory, PAGE_SIZE, MADV_DONTNEED);
+        return;
+    }
+    unsigned long num = (page - frames) * PAGE_SIZE / HUGE_PAGE_SIZE;
+
+    if (++spare[num] == HUGE_PAGE_SIZE / PAGE_SIZE) madvise(arena + num * HUGE_PAGE_SIZE, HUGE_PAGE_SIZE, MADV_DONTNEED);
+}
+
+// Free frames are reused lowest first. With huge pages the shrink evicts the highest frame not
+// touched in the last MEM_PAGE_MIN accesses, so that the upper huge pages drain and can be released.
+// At most MEM_PAGE_MIN frames are skipped per step.
+void Buffer::trim () {
+    for (int i = 0; i < SHRINK_STEP && count - pages.size() > limit && dummy.next != &dummy; i++) {
+        Page *page = dummy.next;
+
+        if (HUGE_PAGE)
+            for (auto iter = used.rbegin(); iter != used.rend(); iter++)
+                if ((*iter)->stamp + MEM_PAGE_MIN <= tick) {
+                    page = *iter;
+                    break;
+                }
+        release(lru_page(page));
+    }
+}
+
+void Buffer::resize (unsigned long num) {
+    // The floor keeps the pages a single tree operation holds from being evicted under it.
+    limit = num < MEM_PAGE_MIN ? MEM_PAGE_MIN : num > MEM_PAGE_MAX ? MEM_PAGE_MAX : num;
+    trim();
+}
+
+void Buffer::open_file (string path, bool flag, bool compress) {
     File *file = NULL;
 
     if (idles.size() > 0) {
@@ -90,15 +227,16 @@ void Buffer::open_file (string path, bool flag) {
     else file = new File();
 
     file->path = path;
+    file->file_id = -1;
+    file->reading = 0;
+    file->refs = 0;
 
-    if (flag) {
-        file->file_id = open(path.c_str(), O_RDWR | O_CREAT, 0664);
-        file->new_page();
-    }
-    else file->file_id = open(path.c_str(), O_RDWR, 0664);
+    if (TABLESPACE) file->space_id = flag ? get_space()->create(path) : get_space()->find(path);
+    else if (flag) file->handle(O_CREAT);
 
-    Page *page = add_page(file, 0);
-    file->pages[0] = page;
+    if (flag) file->new_page(compress);
+
+    file->compress = file->fetch_info()->format == FILE_FORMAT && file->fetch_info()->compress;
 
     files[path] = file;
 }
@@ -107,78 +245,156 @@ void Buffer::quit_file (string path) {
     File *file = files[path];
 
     for (const auto& [page_id, page] : file->pages) {
+        if (!page_id) continue;
+        if (page->updated) page->write_back();
+
+        pull(page);
+        release(page);
+    }
+    auto iter = file->pages.find(0);
+
+    if (iter != file->pages.end()) {
+        Page *page = iter->second;
         if (page->updated) page->write_back();
 
-        if (page_id) pull(page);
-        else pinned.erase(path);
+        if (!file->refs) pull(page);
+        release(page);
+    }
 
-        pages.push_back(page);
+    if (file->next) {
+        close(file->file_id);
+        pull(file);
+        handles -= 1;
     }
-    close(file->file_id);
+    file->file_id = -1;
+    file->refs = 0;
     file->pages.clear();
 
     files.erase(path);
     idles.push_back(file);
 }
 
-void Buffer::create_file (string path) { open_file(path, true); }
+void Buffer::create_file (string path, bool compress) { open_file(path, true, compress); }
 
 void Buffer::delete_file (string path) {
     if (files.find(path) != files.end()) quit_file(path);
-    remove(path.c_str());
+
+    if (TABLESPACE) get_space()->remove(path);
+    else remove(path.c_str());
 }
 
+bool Buffer::exist_file (string path) { return TABLESPACE ? get_space()->exist(path) : access(path.c_str(), F_OK) == 0; }
+
 File *Buffer::operator[] (string path) {
-    if (files.find(path) == files.end()) open_file(path);
+    if (files.find(path) == files.end()) {
+        if (!exist_file(path)) return NULL;
+        open_file(path);
+    }
     return files[path];
 }
 
-inline Info *File::fetch_info () { return (Info *)((*pages[0])[0]); }
+int File::handle (int flag) {
+    Buffer *buffer = get_buffer();
+
+    if (file_id >= 0) {
+        buffer->pull(this);
+        buffer->push(this);
+
+        return file_id;
+    }
+    File *file = buffer->opened.next;
+    while (file != &buffer->opened && file->reading) file = file->next;
+
+    if (buffer->handles >= FD_CACHE_NUM && file != &buffer->opened) {
+        close(file->file_id);
+        file->file_id = -1;
+
+        buffer->pull(file);
+        buffer->handles -= 1;
+    }
+    file_id = open(path.c_str(), O_RDWR | flag | (DIRECT_IO ? O_DIRECT : 0), 0664);
+    if (file_id < 0) return file_id;
+
+    buffer->push(this);
+    buffer->handles += 1;
+
+    return file_id;
+}
+
+int File::locate (unsigned long page_id, unsigned long *offset) {
+    if (TABLESPACE) return get_space()->locate(space_id, page_id, offset);
+
+    *offset = page_id * PAGE_SIZE;
+    return handle();
+}
+
+// Loads the header page again if it has been evicted.
+inline Info *File::fetch_info () { return (Info *)((*get_page(0))[0]); }
 
 Page *File::get_page (unsigned long page_id) {
-    if (page_id == 0) return pages[0];
-    
     Buffer *buffer = get_buffer();
+    buffer->trim();
 
     if (pages.find(page_id) == pages.end()) {
+        if (page_id) buffer->hold(this);
+
         Page *page = buffer->add_page(this, page_id);
         pages[page_id] = page;
 
         return page;
     }
     Page *page = pages[page_id];
-
-    buffer->pull(page);
-    buffer->push(page);
+    buffer->touch(page);
 
     return page;
 }
 
-void File::new_page () {
+Stat File::fetch_stat () {
+    Info *info = fetch_info();
+    Stat stat;
+
+    stat.raw = info->total * PAGE_SIZE;
+    stat.disk = compress ? PAGE_SIZE + info->extent : stat.raw;
+
+    return stat;
+}
+
+void File::new_page (bool compress) {
     Info info;
     info.head.page_id = info.head.offset = info.tail.page_id = 0;
     info.tail.offset = sizeof(Info);
     info.total = 1;
+    info.extent = 0;
+    info.format = FILE_FORMAT;
+    info.compress = compress;
 
-    char temp[PAGE_SIZE];
+    alignas(BLOCK_SIZE) char temp[PAGE_SIZE] = {};
     memcpy(temp, &info, sizeof(Info));
 
-    lseek(file_id, 0, SEEK_SET);
-    write(file_id, temp, PAGE_SIZE);
+    unsigned long offset;
+    int fd = locate(0, &offset);
+
+    lseek(fd, offset, SEEK_SET);
+    write(fd, temp, PAGE_SIZE);
 }
 
 void File::add_page () {
+    Buffer *buffer = get_buffer();
+    buffer->hold(this);
+
     Info *info = fetch_info();
-    Page *page = get_buffer()->get_page(this);
+    Page *page = buffer->get_page();
 
     page->page_id = info->tail.page_id = info->total++;
     info->tail.offset = 0;
 
     page->file = this;
+    page->extent = 0;
+    memset(page->memory, 0, PAGE_SIZE);
     page->write_back();
 
     pages[page->page_id] = page;
-    get_buffer()->push(page);
+    buffer->push(page);
 
     pages[0]->updated = true;
 }
@@ -189,7 +405,7 @@ Addr File::insert_item (void *src, int size) {
 
     if (info->head.page_id || info->head.offset)
         memcpy(&addr, &(info->head), sizeof(Addr));
-    else if (PAGE_SIZE - info->tail.offset - sizeof(Addr) >= size)
+    else if ((compress ? PAGE_SIZE - PAGE_HEAD : PAGE_SIZE) - info->tail.offset - sizeof(Addr) >= size)
         memcpy(&addr, &(info->tail), sizeof(Addr));
     else {
         add_page();
@@ -249,15 +465,64 @@ void Page::init (File *file, unsigned long page_id) {
     this->file = file;
     this->page_id = page_id;
 
-    lseek(file->file_id, page_id * PAGE_SIZE, SEEK_SET);
-    read(file->file_id, memory, PAGE_SIZE);
+    unsigned long offset;
+    int fd = file->locate(page_id, &offset);
+
+    load(fd, offset);
+}
+
+// Only touches the frame itself, so it may run on an I/O thread of the loop.
+void Page::load (int fd, unsigned long offset) {
+    if (!page_id || !file->compress) {
+        pread(fd, memory, PAGE_SIZE, offset);
+        return;
+    }
+    alignas(BLOCK_SIZE) char temp[PAGE_SIZE];
+    pread(fd, temp, PAGE_SIZE, offset);
+
+    unsigned short size = *(unsigned short *)(void *)temp;
+
+    if (size != PAGE_RAW) decompress(temp + PAGE_HEAD, size, memory, PAGE_SIZE);
+    else {
+        memcpy(memory, temp + PAGE_HEAD, PAGE_SIZE - PAGE_HEAD);
+        memset(memory + PAGE_SIZE - PAGE_HEAD, 0, PAGE_HEAD);
+    }
+    extent = size != PAGE_RAW ? (PAGE_HEAD + size + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE : PAGE_SIZE;
 }
 
 inline void *Page::operator[] (unsigned short offset) { return memory + offset; }
 
 void Page::write_back () {
-    lseek(file->file_id, page_id * PAGE_SIZE, SEEK_SET);
-    write(file->file_id, memory, PAGE_SIZE);
+    unsigned long offset;
+    int fd = file->locate(page_id, &offset);
+
+    lseek(fd, offset, SEEK_SET);
+
+    if (!page_id || !file->compress) {
+        write(fd, memory, PAGE_SIZE);
+        updated = false;
+
+        return;
+    }
+    alignas(BLOCK_SIZE) char temp[PAGE_SIZE] = {};
+    int result = compress(memory, PAGE_SIZE - PAGE_HEAD, temp + PAGE_HEAD, PAGE_SIZE - PAGE_HEAD - 1);
+    unsigned short size = result < 0 ? PAGE_RAW : result;
+
+    if (size == PAGE_RAW) memcpy(temp + PAGE_HEAD, memory, PAGE_SIZE - PAGE_HEAD);
+    memcpy(temp, &size, PAGE_HEAD);
+
+    unsigned long length = size != PAGE_RAW ? (PAGE_HEAD + size + BLOCK_SIZE - 1) / BLOCK_SIZE * BLOCK_SIZE : PAGE_SIZE;
+    write(fd, temp, length);
+
+    // Release the unused tail of the slot. Without hole support the whole slot stays allocated.
+    if (length < PAGE_SIZE && fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, offset + length, PAGE_SIZE - length))
+        length = PAGE_SIZE;
+
+    // The header is held while the file has other pages, so it is resident here.
+    Info *info = (Info *)((*file->pages[0])[0]);
+    info->extent = info->extent + length - extent;
+    extent = length;
 
+    file->pages[0]->updated = true;
     updated = false;
 }
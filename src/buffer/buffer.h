@@ -2,6 +2,7 @@
 #define _BUFFER_H_
 
 #include <vector>
+#include <set>
 #include <unordered_map>
 #include <string>
 
@@ -14,28 +15,41 @@ typedef struct {
     unsigned short offset;
 } Addr;
 
+// Fields added after the baseline format sit in the tail of the reserved
+// area, so sizeof(Info) and all earlier offsets are unchanged.
 typedef struct {
     Addr head, tail;
     unsigned long total;
-    char reserved[RESERVE_SPACE];
+    char reserved[RESERVE_SPACE - 16];
+    unsigned long extent;
+    unsigned int format;
+    bool compress;
 } Info;
 
+typedef struct {
+    unsigned long raw, disk;
+} Stat;
+
 class File;
+class Loop;
 
 class Page {
     friend class Bptree;
+    friend class AsyncBptree;
     friend class Buffer;
     friend class File;
+    friend class Loop;
 
-    char memory[PAGE_SIZE];
+    char *memory;
 
     File *file;
-    unsigned long page_id;
+    unsigned long page_id, extent, stamp;
     bool updated;
 
     Page *last, *next;
 
     void init (File *file, unsigned long page_id);
+    void load (int fd, unsigned long offset);
     void *operator[] (unsigned short offset);
     void write_back ();
 };
@@ -44,15 +58,24 @@ class File {
     friend class Bptree;
     friend class Buffer;
     friend class Page;
+    friend class Loop;
 
-    unsigned int file_id;
+    int file_id;
+    unsigned int space_id;
+    unsigned int reading, refs;
     string path;
+    bool compress;
 
     unordered_map<unsigned long, Page*> pages;
 
+    File *last, *next;
+
+    int handle (int flag=0);
+    int locate (unsigned long page_id, unsigned long *offset);
+
     void add_page ();
     Page *get_page (unsigned long page_id);
-    void new_page ();
+    void new_page (bool compress);
 
 public:
     Addr insert_item (void *src, int size);
@@ -60,21 +83,30 @@ public:
     void update_item (Addr addr, void *src, int size);
     void search_item (Addr addr, void *tar, int size);
     Info *fetch_info ();
+    Stat fetch_stat ();
 };
 
 class Buffer {
     friend Buffer *get_buffer ();
     friend class File;
+    friend class Loop;
 
     unordered_map<string, File*> files;
     vector<File*> idles;
 
     Page dummy;
 
-    vector<Page*> pages;
-    unordered_map<string, Page*> pinned;
+    File opened;
+    unsigned long handles;
+
+    char *arena;
+    unsigned long size;
 
-    unsigned long count;
+    Page *frames;
+    unsigned long count, limit, tick;
+    vector<unsigned int> spare;
+
+    set<Page*> pages, used;
 
     Buffer ();
     ~Buffer ();
@@ -82,17 +114,31 @@ class Buffer {
     void pull (Page *page);
     void push (Page *page);
 
-    Page *lru_page (File *file);
+    void pull (File *file);
+    void push (File *file);
+
+    void touch (Page *page);
+    void hold (File *file);
+    void drop (File *file);
+
+    Page *lru_page (Page *page=NULL);
     Page *add_page (File *file, unsigned long page_id);
-    Page *get_page (File *file);
+    Page *get_page ();
 
-    void open_file (string path, bool flag=false);
+    void take (Page *page);
+    void release (Page *page);
+    void trim ();
+
+    void open_file (string path, bool flag=false, bool compress=false);
     void quit_file (string path);
 
 public:
-    void create_file (string path);
+    void create_file (string path, bool compress=false);
     void delete_file (string path);
+    bool exist_file (string path);
     File *operator[] (string path);
+
+    void resize (unsigned long num);
 };
 
 Buffer *get_buffer ();
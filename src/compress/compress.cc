@@ -0,0 +1,71 @@
+#include <string.h>
+
+#include "compress.h"
+
+// Zero-run codec. A token byte below 0x80 is followed by (token + 1) literal
+// bytes; otherwise it and the next byte hold a 15-bit zero run length - 1.
+// Trailing zeros are dropped, decompress pads the output up to its limit.
+// compress returns -1 when the output does not fit in limit bytes.
+
+#define LITERAL_MAX 0x80
+#define ZERO_MAX 0x8000
+#define ZERO_MIN 3
+
+int compress (const char *src, int size, char *tar, int limit) {
+    int head = 0, count = 0, literal = -1;
+
+    while (head < size) {
+        int zero = 0;
+        while (head + zero < size && zero < ZERO_MAX && !src[head + zero]) zero += 1;
+
+        if (head + zero == size) break;
+
+        if (zero >= ZERO_MIN) {
+            if (count + 2 > limit) return -1;
+
+            tar[count++] = (char)(0x80 | (zero - 1) >> 8);
+            tar[count++] = (char)((zero - 1) & 0xff);
+
+            head += zero;
+            literal = -1;
+
+            continue;
+        }
+        if (literal < 0 || tar[literal] == LITERAL_MAX - 1) {
+            if (count + 1 > limit) return -1;
+
+            literal = count;
+            tar[count++] = -1;
+        }
+        if (count + 1 > limit) return -1;
+
+        tar[literal] += 1;
+        tar[count++] = src[head++];
+    }
+    return count;
+}
+
+void decompress (const char *src, int size, char *tar, int limit) {
+    int head = 0, count = 0;
+
+    while (head < size && count < limit) {
+        unsigned char token = src[head++];
+
+        if (token & 0x80) {
+            int zero = ((token & 0x7f) << 8 | (unsigned char)src[head++]) + 1;
+            if (zero > limit - count) zero = limit - count;
+
+            memset(tar + count, 0, zero);
+            count += zero;
+        }
+        else {
+            int num = token + 1;
+            if (num > limit - count) num = limit - count;
+
+            memcpy(tar + count, src + head, num);
+            head += token + 1;
+            count += num;
+        }
+    }
+    memset(tar + count, 0, limit - count);
+}
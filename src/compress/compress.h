@@ -0,0 +1,7 @@
+#ifndef _COMPRESS_H_
+#define _COMPRESS_H_
+
+int compress (const char *src, int size, char *tar, int limit);
+void decompress (const char *src, int size, char *tar, int limit);
+
+#endif
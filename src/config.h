@@ -2,8 +2,30 @@
 #define _CONFIG_H_
 
 #define RESERVE_SPACE 512
+#define FILE_FORMAT 0x53450001
 #define PAGE_SIZE 16384
 #define MEM_PAGE_NUM 4096
+#define MEM_PAGE_MAX 65536
+#define MEM_PAGE_MIN 64
+#define SHRINK_STEP 8
+
+#define PAGE_HEAD 2
+#define PAGE_RAW 0xffff
+#define BLOCK_SIZE 4096
+
+#define HUGE_PAGE_SIZE (2 << 20)
+// HUGE_PAGE maps the whole MEM_PAGE_MAX arena from hugetlb pages, which needs
+// vm.nr_hugepages >= MEM_PAGE_MAX * PAGE_SIZE / HUGE_PAGE_SIZE (512 by default).
+// With fewer reserved the arena falls back to transparent huge pages.
+#define HUGE_PAGE 0
+#define DIRECT_IO 0
+
+#define FD_CACHE_NUM 1024
+#define TABLESPACE 0
+#define SPACE_NAME "space"
+#define SEGMENT_PAGE_NUM 65536
+
+#define IO_THREAD_NUM 16
 
 #define ITEM_NUM 10
 #define KEY_SIZE 20
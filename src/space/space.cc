@@ -0,0 +1,174 @@
+#include <unistd.h>
+#include <stdio.h>
+#include <fcntl.h>
+
+#include "space.h"
+
+Space *get_space () {
+    static Space space;
+    return &space;
+}
+
+Space::Space () {
+    total = count = 0;
+
+    load();
+    dump();
+}
+
+Space::~Space () {
+    for (int fd : segments) close(fd);
+    close(catalog);
+}
+
+void Space::load () {
+    int fd = open(name_to_path(string(SPACE_NAME) + ".cat").c_str(), O_RDONLY);
+    if (fd < 0) return;
+
+    Entry entry;
+    char path[1 << 16];
+
+    while (read(fd, &entry, sizeof(Entry)) == sizeof(Entry)) {
+        if (read(fd, path, entry.size) != entry.size) break;
+
+        string name(path, entry.size);
+
+        if (entry.op == SPACE_BIND) {
+            ids[name] = entry.space_id;
+            slots[entry.space_id].clear();
+
+            if (entry.space_id >= count) count = entry.space_id + 1;
+        }
+        else if (entry.op == SPACE_MAP) {
+            vector<unsigned long>& pages = slots[entry.space_id];
+
+            if (pages.size() <= entry.page_id) pages.resize(entry.page_id + 1);
+            pages[entry.page_id] = entry.slot;
+
+            if (entry.slot >= total) total = entry.slot + 1;
+        }
+        else if (entry.op == SPACE_DROP) {
+            slots.erase(entry.space_id);
+            ids.erase(name);
+        }
+    }
+    close(fd);
+
+    vector<bool> used(total, false);
+
+    for (const auto& [space_id, pages] : slots)
+        for (unsigned long slot : pages) used[slot] = true;
+    for (unsigned long slot = 0; slot < total; slot++)
+        if (!used[slot]) frees.push_back(slot);
+}
+
+void Space::dump () {
+    string path = name_to_path(string(SPACE_NAME) + ".cat");
+
+    catalog = open((path + ".tmp").c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0664);
+
+    for (const auto& [name, space_id] : ids) {
+        Entry entry = {};
+
+        entry.op = SPACE_BIND;
+        entry.space_id = space_id;
+        log(&entry, name);
+
+        vector<unsigned long>& pages = slots[space_id];
+
+        for (unsigned long page_id = 0; page_id < pages.size(); page_id++) {
+            entry.op = SPACE_MAP;
+            entry.page_id = page_id;
+            entry.slot = pages[page_id];
+            log(&entry);
+        }
+    }
+    // The new catalog replaces the only copy, it has to be on disk before the rename
+    // and the rename itself is durable only once the directory is synced.
+    fsync(catalog);
+    rename((path + ".tmp").c_str(), path.c_str());
+
+    size_t pos = path.rfind('/');
+    int fd = open(pos == string::npos ? "." : path.substr(0, pos).c_str(), O_RDONLY | O_DIRECTORY);
+
+    fsync(fd);
+    close(fd);
+}
+
+void Space::log (Entry *entry, string path) {
+    entry->size = path.size();
+
+    write(catalog, entry, sizeof(Entry));
+    write(catalog, path.c_str(), entry->size);
+}
+
+int Space::segment (unsigned long slot) {
+    unsigned long num = slot / SEGMENT_PAGE_NUM;
+
+    while (segments.size() <= num) {
+        string path = name_to_path(string(SPACE_NAME) + "." + to_string(segments.size()));
+        segments.push_back(open(path.c_str(), O_RDWR | O_CREAT | (DIRECT_IO ? O_DIRECT : 0), 0664));
+    }
+    return segments[num];
+}
+
+bool Space::exist (string path) { return ids.find(path) != ids.end(); }
+
+unsigned int Space::create (string path) {
+    Entry entry = {};
+
+    entry.op = SPACE_BIND;
+    entry.space_id = count++;
+    log(&entry, path);
+
+    ids[path] = entry.space_id;
+    slots[entry.space_id].clear();
+
+    return entry.space_id;
+}
+
+void Space::remove (string path) {
+    if (!exist(path)) return;
+
+    Entry entry = {};
+
+    entry.op = SPACE_DROP;
+    entry.space_id = ids[path];
+    log(&entry, path);
+
+    for (unsigned long slot : slots[entry.space_id]) {
+        fallocate(segment(slot), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, slot % SEGMENT_PAGE_NUM * PAGE_SIZE, PAGE_SIZE);
+        frees.push_back(slot);
+    }
+    slots.erase(entry.space_id);
+    ids.erase(path);
+}
+
+// Only valid for paths that exist, it never binds a new one.
+unsigned int Space::find (string path) { return ids.find(path)->second; }
+
+int Space::locate (unsigned int space_id, unsigned long page_id, unsigned long *offset) {
+    vector<unsigned long>& pages = slots[space_id];
+
+    if (page_id >= pages.size()) {
+        Entry entry = {};
+
+        entry.op = SPACE_MAP;
+        entry.space_id = space_id;
+        entry.page_id = page_id;
+
+        if (frees.size() > 0) {
+            entry.slot = frees.back();
+            frees.pop_back();
+        }
+        else entry.slot = total++;
+
+        log(&entry);
+
+        pages.resize(page_id + 1);
+        pages[page_id] = entry.slot;
+    }
+    *offset = pages[page_id] % SEGMENT_PAGE_NUM * PAGE_SIZE;
+
+    return segment(pages[page_id]);
+}
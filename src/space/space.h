@@ -0,0 +1,56 @@
+#ifndef _SPACE_H_
+#define _SPACE_H_
+
+#include <vector>
+#include <unordered_map>
+#include <string>
+
+#include "../config.h"
+
+using namespace std;
+
+#define SPACE_BIND 0
+#define SPACE_MAP 1
+#define SPACE_DROP 2
+
+typedef struct {
+    char op;
+    unsigned int space_id;
+    unsigned long page_id, slot;
+    unsigned short size;
+} Entry;
+
+class Space {
+    friend Space *get_space ();
+
+    int catalog;
+    vector<int> segments;
+
+    unordered_map<string, unsigned int> ids;
+    unordered_map<unsigned int, vector<unsigned long>> slots;
+
+    vector<unsigned long> frees;
+    unsigned long total;
+    unsigned int count;
+
+    Space ();
+    ~Space ();
+
+    void load ();
+    void dump ();
+    void log (Entry *entry, string path="");
+
+    int segment (unsigned long slot);
+
+public:
+    bool exist (string path);
+    unsigned int create (string path);
+    void remove (string path);
+    unsigned int find (string path);
+
+    int locate (unsigned int space_id, unsigned long page_id, unsigned long *offset);
+};
+
+Space *get_space ();
+
+#endif